@@ -0,0 +1,39 @@
+#include<esp_timer.h>
+#include<inttypes.h>
+#include<stdbool.h>
+#include<stdio.h>
+#include "boot.h"
+
+#define BOOT_STAGES_MAX 12
+
+typedef struct boot_stamp {
+  const char* stage;
+  uint64_t time;
+} boot_stamp;
+
+static boot_stamp stamps[BOOT_STAGES_MAX];
+static uint8_t stamp_count;
+static bool reported;
+
+void boot_mark(const char* stage) {
+
+  if (reported || stamp_count == BOOT_STAGES_MAX) return;
+  stamps[stamp_count++] = (boot_stamp) {stage, esp_timer_get_time()};
+
+}
+
+void boot_first_frame(void) {
+
+  if (reported) return;
+  boot_mark("first frame");
+  reported = true;
+
+  //each line is when the stage finished, and how long it took after the one before
+  printf("boot: %-20s %10s %10s\n", "stage", "at us", "took us");
+  uint64_t previous = 0;
+  for (int i = 0; i < stamp_count; i++) {
+    printf("boot: %-20s %10" PRIu64 " %10" PRIu64 "\n", stamps[i].stage, stamps[i].time, stamps[i].time - previous);
+    previous = stamps[i].time;
+  }
+
+}
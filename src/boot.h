@@ -0,0 +1,22 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+/*
+====================================================
+Boot timing
+----------------------------------------------------
+
+boot_mark stamps the end of each startup stage with
+esp_timer_get_time (microseconds since the timer started,
+so the bootloader itself isn't counted). boot_first_frame
+is called once the first frame of the first scene has
+been presented, and prints the breakdown. Marks after
+that are ignored.
+
+====================================================
+*/
+
+void boot_mark(const char* stage);
+void boot_first_frame(void);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CIRCLE_TABLE_H
+#define CIRCLE_TABLE_H
+
+#include<stdint.h>
+
+/*
+====================================================
+Circle lookup table
+----------------------------------------------------
+
+Half heights of a filled circle, sqrt(r*r - i*i) rounded
+down, for every column i from the centre out and every
+radius up to CIRCLE_TABLE_MAX. Row r starts at r*(r+1)/2.
+
+Every bubble in the game fits, so draw_circle looks the
+heights up instead of calling sqrt for every column of
+every circle, every frame. This saves per frame work,
+not boot time, the old code never built anything at
+startup.
+
+====================================================
+*/
+
+#define CIRCLE_TABLE_MAX 15
+#define CIRCLE_TABLE_ROW(r) ((r)*((r)+1)/2)
+
+static const uint8_t circle_heights[] = {
+  0, //r=0
+  1, 0, //r=1
+  2, 1, 0, //r=2
+  3, 2, 2, 0, //r=3
+  4, 3, 3, 2, 0, //r=4
+  5, 4, 4, 4, 3, 0, //r=5
+  6, 5, 5, 5, 4, 3, 0, //r=6
+  7, 6, 6, 6, 5, 4, 3, 0, //r=7
+  8, 7, 7, 7, 6, 6, 5, 3, 0, //r=8
+  9, 8, 8, 8, 8, 7, 6, 5, 4, 0, //r=9
+  10, 9, 9, 9, 9, 8, 8, 7, 6, 4, 0, //r=10
+  11, 10, 10, 10, 10, 9, 9, 8, 7, 6, 4, 0, //r=11
+  12, 11, 11, 11, 11, 10, 10, 9, 8, 7, 6, 4, 0, //r=12
+  13, 12, 12, 12, 12, 12, 11, 10, 10, 9, 8, 6, 5, 0, //r=13
+  14, 13, 13, 13, 13, 13, 12, 12, 11, 10, 9, 8, 7, 5, 0, //r=14
+  15, 14, 14, 14, 14, 14, 13, 13, 12, 12, 11, 10, 9, 7, 5, 0, //r=15
+};
+
+#endif
@@ -0,0 +1,368 @@
+#include<graphics.h>
+#ifdef DISPLAY_PARTIAL_SPI
+#include<driver/gpio.h>
+#include<driver/spi_master.h>
+#include<esp_rom_gpio.h>
+#include<soc/gpio_sig_map.h>
+#include<soc/spi_periph.h>
+#endif
+#include<inttypes.h>
+#include<stdio.h>
+#include<string.h>
+#include "display_diff.h"
+
+/*
+====================================================
+Configuration
+----------------------------------------------------
+
+TTGO T-Display wiring for the ST7789, and the panel
+offsets (the 135x240 glass sits inside a 240x320
+controller RAM, so windows need shifting).
+
+None of the panel values below have been checked
+against the graphics library source or on a board, which
+is why the partial SPI path is opt in. PANEL_HOST and
+PANEL_LIB_CS_SLOT have to match how the library set up
+its own device: the SPI host its bus is on, and which CS
+slot its device got (0 if it is the first device on the
+bus). They can be overridden with build flags.
+
+Window overhead is CASET + 4 bytes, RASET + 4 bytes
+and RAMWR, which is what gets charged per window.
+
+====================================================
+*/
+
+#ifndef PANEL_HOST
+#define PANEL_HOST        HSPI_HOST
+#endif
+#ifndef PANEL_LIB_CS_SLOT
+#define PANEL_LIB_CS_SLOT 0
+#endif
+#define PANEL_PIN_CS      5
+#define PANEL_PIN_DC      16
+#define PANEL_CLOCK_HZ    (40*1000*1000)
+#define PANEL_MAX_CHUNK   4092  //default max transfer size of a DMA enabled bus, capped by the real bus in init
+
+#define ST7789_CASET 0x2A
+#define ST7789_RASET 0x2B
+#define ST7789_RAMWR 0x2C
+
+#define WINDOW_OVERHEAD_BYTES 11
+#define MAX_ROWS 240
+//columns are hashed in this many bands, so edge only changes don't resend the middle
+#define BANDS 5
+
+//every so often push a whole frame anyway, so a hash collision can't leave junk on screen for long
+#define FULL_REFRESH_FRAMES 120
+//when this share of the screen (out of 4) is dirty, one async flip_frame beats lots of polled windows
+#define FULL_FRAME_QUARTERS 3
+#define REPORT_FRAMES 100
+
+static uint32_t band_hash[MAX_ROWS][BANDS];
+static uint32_t sent_hash[MAX_ROWS][BANDS];
+static bool hashes_valid;
+static int last_width, last_height;
+static display_stats stats;
+
+#ifdef DISPLAY_PARTIAL_SPI
+static spi_device_handle_t panel_spi;
+static bool panel_ready;
+static size_t panel_max_chunk = PANEL_MAX_CHUNK;
+static DMA_ATTR uint16_t panel_chunk[PANEL_MAX_CHUNK / sizeof(uint16_t)];
+#endif
+
+/*
+====================================================
+Panel bus
+----------------------------------------------------
+
+Only built with -DDISPLAY_PARTIAL_SPI. Without it every
+frame goes out through flip_frame, and the windows are
+only counted, so the savings can still be measured.
+
+A second device on the graphics library's SPI bus, so
+windows can be sent without touching its driver. It is
+added without a CS pin, the library's device already
+owns GPIO5 and esp-idf can't share a CS pin between two
+devices. Instead, while the bus is acquired, the pin is
+taken off the library's CS signal and held low by hand,
+then handed back. The DC line is set in the pre transfer
+callback from the transaction's user field, same as the
+esp-idf lcd example.
+
+After the partial windows the full screen window is set
+again, so a following flip_frame writes the whole panel
+even if the library only sends RAMWR.
+
+If the device can't be added (no bus on PANEL_HOST etc)
+everything falls back to flip_frame. If any transfer in a
+partial update fails, that frame is flipped in full and
+the hashes are thrown away, so nothing is left stale.
+
+====================================================
+*/
+
+#ifdef DISPLAY_PARTIAL_SPI
+
+static void IRAM_ATTR panel_pre_transfer(spi_transaction_t *t) {
+  gpio_set_level(PANEL_PIN_DC, (int) (intptr_t) t->user);
+}
+
+static void panel_select(bool select) {
+
+  if (select) {
+    esp_rom_gpio_pad_select_gpio(PANEL_PIN_CS);
+    gpio_set_direction(PANEL_PIN_CS, GPIO_MODE_OUTPUT);
+    esp_rom_gpio_connect_out_signal(PANEL_PIN_CS, SIG_GPIO_OUT_IDX, false, false);
+    gpio_set_level(PANEL_PIN_CS, 0);
+  } else {
+    gpio_set_level(PANEL_PIN_CS, 1);
+    esp_rom_gpio_connect_out_signal(PANEL_PIN_CS, spi_periph_signal[PANEL_HOST].spics_out[PANEL_LIB_CS_SLOT], false, false);
+  }
+
+}
+
+static esp_err_t panel_send(const void *data, size_t len, int dc) {
+
+  const uint8_t *bytes = data;
+  while (len > 0) {
+    size_t chunk = len > panel_max_chunk ? panel_max_chunk : len;
+    spi_transaction_t t;
+    memset(&t, 0, sizeof(t));
+    t.length = chunk * 8;
+    t.tx_buffer = bytes;
+    t.user = (void*) (intptr_t) dc;
+    esp_err_t err = spi_device_polling_transmit(panel_spi, &t);
+    if (err != ESP_OK) return err;
+    bytes += chunk;
+    len -= chunk;
+  }
+  return ESP_OK;
+
+}
+
+static esp_err_t panel_set_window(int x0, int x1, int y0, int y1) {
+
+  int x_offset = 52, y_offset = 40;
+  if (display_width != 135) {
+    x_offset = 40;
+    y_offset = 53;
+  }
+
+  uint16_t x_start = x_offset + x0, x_end = x_offset + x1;
+  uint16_t y_start = y_offset + y0, y_end = y_offset + y1;
+  uint8_t caset[4] = {x_start >> 8, x_start & 0xff, x_end >> 8, x_end & 0xff};
+  uint8_t raset[4] = {y_start >> 8, y_start & 0xff, y_end >> 8, y_end & 0xff};
+  uint8_t cmd;
+  esp_err_t err;
+
+  cmd = ST7789_CASET;
+  if ((err = panel_send(&cmd, 1, 0)) != ESP_OK) return err;
+  if ((err = panel_send(caset, 4, 1)) != ESP_OK) return err;
+  cmd = ST7789_RASET;
+  if ((err = panel_send(&cmd, 1, 0)) != ESP_OK) return err;
+  return panel_send(raset, 4, 1);
+
+}
+
+//band pixels aren't contiguous in the frame buffer, so rows are gathered into a chunk before sending
+static esp_err_t panel_write_window(int x0, int x1, int y0, int y1) {
+
+  int band_width = x1 - x0 + 1;
+  int chunk_rows = (panel_max_chunk / sizeof(uint16_t)) / band_width;
+  uint8_t cmd = ST7789_RAMWR;
+  esp_err_t err;
+
+  if (chunk_rows < 1) return ESP_ERR_INVALID_SIZE;
+  if ((err = panel_set_window(x0, x1, y0, y1)) != ESP_OK) return err;
+  if ((err = panel_send(&cmd, 1, 0)) != ESP_OK) return err;
+
+  for (int y = y0; y <= y1; y += chunk_rows) {
+    int rows = y1 - y + 1 < chunk_rows ? y1 - y + 1 : chunk_rows;
+    for (int r = 0; r < rows; r++) {
+      memcpy(&panel_chunk[r * band_width], &frame_buffer[(y + r) * display_width + x0], band_width * sizeof(uint16_t));
+    }
+    if ((err = panel_send(panel_chunk, rows * band_width * sizeof(uint16_t), 1)) != ESP_OK) return err;
+  }
+  return ESP_OK;
+
+}
+
+#endif
+
+/*
+====================================================
+Band hashing
+----------------------------------------------------
+
+FNV-1a over each 16 bit pixel of a row band. That is
+the whole frame once per frame, which is cheap next to
+the SPI transfer it saves.
+
+====================================================
+*/
+
+static inline uint32_t hash_pixels(const uint16_t *pixels, int count) {
+
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < count; i++) {
+    hash ^= pixels[i];
+    hash *= 16777619u;
+  }
+  return hash;
+
+}
+
+static inline int band_start(int band, int width) {
+  return band * ((width + BANDS - 1) / BANDS);
+}
+
+static inline int band_end(int band, int width) {
+  int end = band_start(band + 1, width) - 1;
+  return end < width ? end : width - 1;
+}
+
+void display_diff_init(void) {
+
+  hashes_valid = false;
+  memset(&stats, 0, sizeof(stats));
+
+#ifdef DISPLAY_PARTIAL_SPI
+  if (panel_ready) return;
+
+  spi_device_interface_config_t devcfg;
+  memset(&devcfg, 0, sizeof(devcfg));
+  devcfg.clock_speed_hz = PANEL_CLOCK_HZ;
+  devcfg.mode = 0;
+  devcfg.spics_io_num = -1; //CS is driven by hand in panel_select
+  devcfg.queue_size = 1;
+  devcfg.pre_cb = panel_pre_transfer;
+
+  esp_err_t err = spi_bus_add_device(PANEL_HOST, &devcfg, &panel_spi);
+  //the library may have set up its bus with a smaller max_transfer_sz than the default
+  size_t bus_max = 0;
+  if (err == ESP_OK) err = spi_bus_get_max_transaction_len(PANEL_HOST, &bus_max);
+  if (err == ESP_OK && bus_max < panel_max_chunk) panel_max_chunk = bus_max & ~1u;
+  panel_ready = (err == ESP_OK);
+  if (!panel_ready) {
+    printf("display_diff: partial updates unavailable (%s), using flip_frame\n", esp_err_to_name(err));
+  }
+#endif
+
+}
+
+void display_present(void) {
+
+  int width = display_width;
+  int height = display_height;
+  uint32_t full_bytes = width * height * sizeof(uint16_t) + WINDOW_OVERHEAD_BYTES;
+
+  //orientation change (or first frame) means the panel contents are unknown
+  if (width != last_width || height != last_height || height > MAX_ROWS) {
+    hashes_valid = false;
+    last_width = width;
+    last_height = height;
+  }
+
+  int dirty_pixels = 0;
+  int rows = height > MAX_ROWS ? MAX_ROWS : height;
+  for (int y = 0; y < rows; y++) {
+    for (int band = 0; band < BANDS; band++) {
+      int x0 = band_start(band, width), x1 = band_end(band, width);
+      band_hash[y][band] = x0 <= x1 ? hash_pixels(&frame_buffer[y * width + x0], x1 - x0 + 1) : 0;
+      if (!hashes_valid || band_hash[y][band] != sent_hash[y][band]) dirty_pixels += x1 - x0 + 1;
+    }
+  }
+
+  bool full = !hashes_valid
+    || height > MAX_ROWS
+    || stats.frames % FULL_REFRESH_FRAMES == 0
+    || dirty_pixels * 4 >= rows * width * FULL_FRAME_QUARTERS;
+  bool sent = true;
+#ifdef DISPLAY_PARTIAL_SPI
+  if (!panel_ready) full = true;
+  esp_err_t err = ESP_OK;
+  bool acquired = false;
+#endif
+
+  stats.frame_windows = 0;
+  stats.frame_bytes = 0;
+
+  if (!full) {
+
+#ifdef DISPLAY_PARTIAL_SPI
+    //waits for anything the library still has queued, so the CS pin is free to take over
+    err = spi_device_acquire_bus(panel_spi, portMAX_DELAY);
+    acquired = (err == ESP_OK);
+    if (acquired) panel_select(true);
+#endif
+    //walk each band collecting contiguous dirty rows into one window
+    for (int band = 0; band < BANDS && sent; band++) {
+      int x0 = band_start(band, width), x1 = band_end(band, width);
+      if (x0 > x1) continue;
+      int y = 0;
+      while (y < rows && sent) {
+        if (band_hash[y][band] == sent_hash[y][band]) {
+          y++;
+          continue;
+        }
+        int span_start = y;
+        while (y < rows && band_hash[y][band] != sent_hash[y][band]) y++;
+
+#ifdef DISPLAY_PARTIAL_SPI
+        if (err == ESP_OK) err = panel_write_window(x0, x1, span_start, y - 1);
+        sent = (err == ESP_OK);
+#endif
+        stats.frame_windows++;
+        stats.frame_bytes += (y - span_start) * (x1 - x0 + 1) * sizeof(uint16_t) + WINDOW_OVERHEAD_BYTES;
+      }
+    }
+#ifdef DISPLAY_PARTIAL_SPI
+    if (err == ESP_OK) err = panel_set_window(0, width - 1, 0, height - 1);
+    sent = (err == ESP_OK);
+    if (acquired) {
+      panel_select(false);
+      spi_device_release_bus(panel_spi);
+    }
+    if (!sent) {
+      printf("display_diff: partial update failed (%s), flipping the full frame\n", esp_err_to_name(err));
+      full = true;
+    }
+#endif
+
+  }
+
+  if (full) {
+    stats.frame_windows = 1;
+    stats.frame_bytes = full_bytes;
+  }
+  stats.frame_full = full;
+
+  //a failed partial leaves the hashes invalid, so the next frame goes out in full as well
+  memcpy(sent_hash, band_hash, rows * sizeof(sent_hash[0]));
+  hashes_valid = sent;
+
+  //without DISPLAY_PARTIAL_SPI the windows above were only counted, the whole frame still goes out
+#ifdef DISPLAY_PARTIAL_SPI
+  if (full) flip_frame();
+#else
+  flip_frame();
+#endif
+
+  stats.frames++;
+  stats.total_bytes += stats.frame_bytes;
+  stats.total_full_bytes += full_bytes;
+
+  if (stats.frames % REPORT_FRAMES == 0) {
+    printf("display_diff: frame %" PRIu32 " %" PRIu32 " bytes (%u windows), avg %" PRIu32 " of %" PRIu32 " bytes/frame\n",
+      stats.frames, stats.frame_bytes, stats.frame_windows,
+      (uint32_t) (stats.total_bytes / stats.frames), full_bytes);
+  }
+
+}
+
+const display_stats* display_get_stats(void) {
+  return &stats;
+}
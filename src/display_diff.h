@@ -0,0 +1,43 @@
+#ifndef DISPLAY_DIFF_H
+#define DISPLAY_DIFF_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/*
+====================================================
+Differential display transfer
+----------------------------------------------------
+
+display_present is a drop in replacement for flip_frame.
+Each row is hashed in a few column bands, and only the
+runs of rows that changed in a band are pushed, each
+through its own ST7789 column/row address window. The
+sidewall bubbles only dirty the edge bands, so the middle
+of the screen isn't resent every game frame.
+
+The SPI writes themselves are opt in with
+-DDISPLAY_PARTIAL_SPI, they rely on details of the
+graphics library's bus that haven't been checked on a
+board yet. Without it every frame still goes out through
+flip_frame, and the windows are only counted, so the
+bytes that would be saved are reported on any build,
+emulator included.
+
+====================================================
+*/
+
+typedef struct display_stats {
+  uint32_t frame_bytes;    //bytes sent (or simulated) for the last frame
+  uint16_t frame_windows;  //address windows opened for the last frame
+  bool frame_full;         //last frame went out through flip_frame
+  uint32_t frames;
+  uint64_t total_bytes;
+  uint64_t total_full_bytes; //what the same frames would have cost with flip_frame
+} display_stats;
+
+void display_diff_init(void);
+void display_present(void);
+const display_stats* display_get_stats(void);
+
+#endif
@@ -0,0 +1,140 @@
+#include<graphics.h>
+#include<fonts.h>
+#include<inttypes.h>
+#include<stdio.h>
+#include<string.h>
+#include "governor.h"
+
+/*
+====================================================
+Tiers
+----------------------------------------------------
+
+Each tier gives up a little more, cheapest to notice
+first: menu bubble layers, sidewall rings and score
+refresh, then fewer sidewall bubbles on screen.
+
+====================================================
+*/
+
+static const quality_settings tiers[] = {
+  {3, 2, 0,  0},
+  {2, 1, 0,  250000},
+  {2, 1, 15, 500000},
+  {1, 1, 30, 500000},
+};
+#define TIER_COUNT (sizeof(tiers)/sizeof(tiers[0]))
+
+#define WINDOW_FRAMES 16
+//only restore once the average has stayed under this percentage of the budget for the hold,
+//stops it flapping between tiers
+#define RESTORE_PERCENT 70
+#define RESTORE_HOLD_FRAMES 60
+//a restore that gets stepped straight back down doubles the hold, up to this
+#define RESTORE_HOLD_MAX (RESTORE_HOLD_FRAMES*16)
+//one long stall (button release delay, first frame) shouldn't drop the quality on its own
+#define MAX_SAMPLE_BUDGETS 4
+
+static uint32_t budget;
+static uint32_t samples[WINDOW_FRAMES];
+static uint32_t sample_sum;
+static uint8_t sample_index, sample_count;
+static uint16_t frames_since_change;
+static uint16_t frames_under;  //consecutive frames the average has been under the restore threshold
+static uint16_t restore_hold;
+static bool last_change_restore;
+static uint8_t tier;
+
+#ifdef GOVERNOR_OVERLAY
+//overlay text only changes with the tier or the average to the nearest OVERLAY_ROUND_US,
+//so it doesn't dirty its rows for the display diff every frame
+#define OVERLAY_ROUND_US 5000
+static char overlay[32];
+static uint8_t overlay_tier = UINT8_MAX;
+static uint32_t overlay_average = UINT32_MAX;
+#endif
+
+void governor_init(uint32_t budget_us) {
+
+  budget = budget_us;
+  memset(samples, 0, sizeof(samples));
+  sample_sum = 0;
+  sample_index = 0;
+  sample_count = 0;
+  frames_since_change = 0;
+  frames_under = 0;
+  restore_hold = RESTORE_HOLD_FRAMES;
+  last_change_restore = false;
+  tier = 0;
+
+}
+
+static void set_tier(uint8_t new_tier, uint32_t average) {
+
+  printf("governor: tier %u -> %u (avg frame %" PRIu32 "us, budget %" PRIu32 "us)\n",
+    tier, new_tier, average, budget);
+  last_change_restore = new_tier < tier;
+  tier = new_tier;
+  frames_since_change = 0;
+  frames_under = 0;
+
+}
+
+void governor_frame(uint64_t frame_time_us) {
+
+  uint32_t sample = frame_time_us > (uint64_t) budget * MAX_SAMPLE_BUDGETS
+    ? budget * MAX_SAMPLE_BUDGETS : frame_time_us;
+
+  //rolling window, the oldest sample drops out of the sum as the new one goes in
+  sample_sum -= samples[sample_index];
+  samples[sample_index] = sample;
+  sample_sum += sample;
+  sample_index = (sample_index + 1) % WINDOW_FRAMES;
+  if (sample_count < WINDOW_FRAMES) sample_count++;
+  if (frames_since_change < UINT16_MAX) frames_since_change++;
+
+  if (sample_count < WINDOW_FRAMES) return;
+
+  uint32_t average = sample_sum / WINDOW_FRAMES;
+
+  //wait a full window after a change so the average reflects the new tier
+  if (frames_since_change < WINDOW_FRAMES) return;
+
+  if (average < budget / 100 * RESTORE_PERCENT) {
+    if (frames_under < UINT16_MAX) frames_under++;
+  } else {
+    frames_under = 0;
+  }
+
+  if (average > budget && tier < TIER_COUNT - 1) {
+    //the first full window after a restore is already over budget, so the restore came too early
+    if (last_change_restore && frames_since_change < WINDOW_FRAMES * 2 && restore_hold < RESTORE_HOLD_MAX) {
+      restore_hold *= 2;
+    }
+    set_tier(tier + 1, average);
+  } else if (tier > 0 && frames_under >= restore_hold) {
+    set_tier(tier - 1, average);
+  }
+
+}
+
+const quality_settings* governor_quality(void) {
+  return &tiers[tier];
+}
+
+void governor_draw_overlay(void) {
+
+#ifdef GOVERNOR_OVERLAY
+  uint32_t average = sample_count ? sample_sum / sample_count : 0;
+  average = (average + OVERLAY_ROUND_US / 2) / OVERLAY_ROUND_US * OVERLAY_ROUND_US;
+  if (tier != overlay_tier || average != overlay_average) {
+    snprintf(overlay, sizeof(overlay), "Q%u %" PRIu32 "ms", tier, average / 1000);
+    overlay_tier = tier;
+    overlay_average = average;
+  }
+  setFont(FONT_SMALL);
+  setFontColour(255,255,0);
+  print_xy(overlay, 90, 2);
+#endif
+
+}
@@ -0,0 +1,36 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/*
+====================================================
+Adaptive quality governor
+----------------------------------------------------
+
+Watches a rolling average of frame times against a
+budget, and steps through quality tiers when frames run
+long, then steps back once there is headroom again.
+Tier 0 is full quality.
+
+quality_settings is what the draw code reads each frame.
+Building with -DGOVERNOR_OVERLAY draws the current tier
+and average frame time in the top right corner.
+
+====================================================
+*/
+
+typedef struct quality_settings {
+  uint8_t sidewall_rings;      //concentric circles drawn per sidewall bubble
+  uint8_t menu_bubble_layers;  //circles drawn per menu/game over bubble
+  float sidewall_spawn_gap;    //extra pixels above the screen a new sidewall bubble starts
+  uint32_t hud_interval;       //microseconds between score refreshes
+} quality_settings;
+
+void governor_init(uint32_t budget_us);
+void governor_frame(uint64_t frame_time_us);
+const quality_settings* governor_quality(void);
+void governor_draw_overlay(void);
+
+#endif
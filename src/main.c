@@ -5,101 +5,15 @@
 #include<driver/gpio.h>
 #include<inttypes.h>
 #include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
 #include<math.h>
-
-/* 
-====================================================
-Struct Definitions
-----------------------------------------------------
-
-vec2f is a utility vector with 2 floats, used for all
-the X/Y type calcs (position, velocity, acceleration)
-
-Piece is a struct made up of mostly vec2f and a 
-utility flag, and represents any moving piece
-
-linked_list and Node work together, linked_list is the 
-head, and holds a incrementing counter and the pointer
-to the first LL element 
-
-====================================================
-*/
-
-
-//Float vector (used for coordinates and velocities)
-typedef struct { float x; float y; } vec2f;
-
-//game pieces
-typedef struct Piece {
-  //Using 2d vector for pieces allows me to use a lot of generic code
-  //its designed with 2d movement in mind, but at present player only
-  //moves side to side, and enemies top to bottom
-  vec2f dimensions;
-  vec2f position;
-  vec2f velocity;
-  vec2f accel;
-  bool flag;
-
-} Piece;
-
-typedef struct Node {
-  Piece piece;
-  struct Node* next;
-} Node;
-typedef struct linked_list {
-  struct Node* first;
-  uint16_t count;
-} linked_list;
-
-void add_node(struct Node *list, struct Node *new) {
-
-  while(list->next != NULL) {
-    list= list->next;
-  }
-  list->next = new;
-
-}
-
-void delete_node(struct linked_list* head, struct Node* target) {
-
-  struct Node* temp = head->first;
-  struct Node* previous = NULL;
-
-  while(temp != target) {
-    previous = temp;
-    temp = temp->next;
-  }
-
-  if(previous == NULL) {
-    head->first = temp->next;
-    head->count--;
-    free(temp);
-  } else {
-    previous->next = temp->next;
-    head->count--;
-    free(temp);
-  }
-
-}
-
-void clear_list(struct linked_list *head) {
-
-  struct Node* temp = head->first;
-  struct Node* previous = NULL;
-
-  while (temp != NULL) {
-
-    previous = temp;
-    temp = temp->next;
-    free(previous);
-
-  }
-
-  head->first = NULL;
-  head->count = 0;
-
-
-}
+#include "boot.h"
+#include "circle_table.h"
+#include "display_diff.h"
+#include "governor.h"
+#include "pieces.h"
+#include "scene.h"
 
 /* 
 ====================================================
@@ -153,9 +67,11 @@ vec2f random_start(int screen_width, vec2f dim) {
 void draw_circle(int radius, int center_x, int center_y, uint16_t colour) {
  
   int radius_sq = radius * radius, height;
+  //all the bubbles fit in the lookup table, anything bigger works the heights out the slow way
+  const uint8_t* heights = radius >= 0 && radius <= CIRCLE_TABLE_MAX ? &circle_heights[CIRCLE_TABLE_ROW(radius)] : NULL;
   //adapted from an answer I made for drawing the japanese flag in 159.102 to a .ppm
   for (int i = 0; i <=radius; i++) {
-    height = sqrt(radius_sq - (i*i));
+    height = heights != NULL ? heights[i] : sqrt(radius_sq - (i*i));
     for (int j = 0;  j<=height; j++) {
       draw_pixel(center_x + i, center_y+j,colour);
       draw_pixel(center_x + i, center_y-j,colour);
@@ -167,9 +83,9 @@ void draw_circle(int radius, int center_x, int center_y, uint16_t colour) {
 
 
 }
-void draw_enemy(Piece enemy) {
+void draw_enemy(const Piece* enemy) {
 
-  draw_rectangle(enemy.position.x, enemy.position.y, enemy.dimensions.x, enemy.dimensions.y, rgbToColour(0,255,0));
+  draw_rectangle(enemy->position.x, enemy->position.y, enemy->dimensions.x, enemy->dimensions.y, rgbToColour(0,255,0));
 
 }
 
@@ -219,528 +135,527 @@ bool test_enemy(Piece enemy, float screen_height) {
   
 }
 
-/* 
-====================================================
-Main
-----------------------------------------------------
-Three sections:
-for(;;)
-  while() - intro screen, press A to run
-  while() - game runs until collision detected
-  while() - finish screen runs until A pressed
 
-====================================================
-*/
-
-void app_main() { 
-
-/* 
+/*
 ====================================================
 Configurations
 ----------------------------------------------------
-Graphics initialisations and gpio directions
 Game overall variables
 Game piece configurations
 Timer variables
+
+These live at file scope now so the scene hooks
+can share them
 ====================================================
 */
-  // configurations for GPIO and graphics initialisations
-  gpio_set_direction(0,GPIO_MODE_INPUT);
-  gpio_set_direction(35,GPIO_MODE_INPUT);
-  graphics_init();
-  set_orientation(PORTRAIT);
-  
-  //game variables
-  uint16_t level;
-  char level_string[100]; //
-  char score_string[100]; //
-  uint32_t score;
-  bool crashed;
-
-  // game piece configurations, variables to allow tuning and eventual expansion by adding menus
-  // position is always the top left corner of the hit box
-  vec2f ship_dimensions = (vec2f) {20,40};
-  vec2f min_ship_pos = (vec2f) {0, 0};
-  vec2f max_ship_pos = (vec2f) {135 - ship_dimensions.x, 240 - ship_dimensions.y};
-  vec2f max_velocity = (vec2f) {100,0}; //pixels per second essentially
-
-  float thrust_accel = 200; //pixels per second per second
-  float drag_decel = 100;
-
-  vec2f enemy_dimesions = (vec2f) {6,16};
-  int first_level_enemies = 5;
-  int max_enemies = 20;
-  vec2f first_level_velocity = (vec2f) {0,10};
-
-  // timer variables
-  uint64_t current_time, last_level_time, last_enemy_time ,last_frame_time = esp_timer_get_time();
-  float dt; //declare as float for the vector calcs.
-
-
-
-  //procedural backgrounds
-  struct linked_list bubbles;
-  struct linked_list sidewalls;
-  bubbles.count = 0;
-  bubbles.first = NULL;
-  sidewalls.count = 0;
-  sidewalls.first = NULL;
 
-/* 
+//game variables
+static uint16_t level;
+static uint32_t score;
+static uint32_t hud_score; //score as shown, only refreshed as often as the quality tier allows
+static bool crashed;
+static Piece ship;
+
+// game piece configurations, variables to allow tuning and eventual expansion by adding menus
+// position is always the top left corner of the hit box
+static const vec2f ship_dimensions = {20,40};
+static const vec2f min_ship_pos = {0, 0};
+static const vec2f max_ship_pos = {135 - 20, 240 - 40}; //screen less the ship dimensions
+static const vec2f max_velocity = {100,0}; //pixels per second essentially
+
+static const float thrust_accel = 200; //pixels per second per second
+static const float drag_decel = 100;
+
+static const vec2f enemy_dimesions = {6,16};
+static const int first_level_enemies = 5;
+static const int max_enemies = 20;
+static const vec2f first_level_velocity = {0,10};
+
+// timer variables
+static uint64_t last_level_time, last_hud_time;
+
+//the score bar is only redrawn when the score shown changes, otherwise it's copied from here
+#define HUD_ROWS 16
+static uint16_t hud_cache[HUD_ROWS*240];
+static uint32_t hud_cached_score;
+static bool hud_cached;
+
+//quality governor, steps detail down if frames take longer than this
+static const uint32_t frame_budget = 1000000/30; //microseconds, aiming for 30fps
+
+/*
 ====================================================
-Game
+Entity groups
 ----------------------------------------------------
+bubbles - menu and game over background
+sidewalls - procedural blood vessel walls
+enemies - the green rectangles
 
+Each has spawn/move/draw/expired hooks that the
+scene pipeline runs
 ====================================================
 */
-  for(;;){
 
-  crashed = false;
-  level = 1;
-  score = 0;
+static void move_piece(Piece* piece, float dt) {
+  piece->position = add_vec(piece->position, mul_vec_by_float(piece->velocity,dt));
+}
+
+//every half a second a new bubble is added to the linked list with a random x position
+//and a random size range
+static void spawn_bubble(entity_group* group, uint64_t now) {
+
+  if (group->last_spawn + 500000 < now) {
+
+    struct Node* temp = NULL;
+    temp = (struct Node*)malloc(sizeof(struct Node));
+    temp->piece.position = random_start(135,(vec2f) {20,20});
+    temp->piece.velocity = (vec2f) {0,20};
+    temp->piece.dimensions = (vec2f) {rand()%10+5,0};
+    temp->next = NULL;
 
+    push_node(&group->list,temp);
+    group->last_spawn = now;
+  }
+
+}
+
+static void draw_bubble(const Piece* piece) {
+
+  draw_circle(piece->dimensions.x,piece->position.x,piece->position.y,rgbToColour(120,0,0));
+  if (governor_quality()->menu_bubble_layers > 1) draw_circle(piece->dimensions.x-2,piece->position.x,piece->position.y,rgbToColour(135,0,0));
+
+}
 
-  last_enemy_time = esp_timer_get_time();
+static bool bubble_expired(const Piece* piece) {
+  return piece->position.y >= 240;
+}
+
+static struct Node* new_sidewall(float x, float y) {
 
-  //draws menu screen and awaits user press of the A key
-  while(gpio_get_level(0)){
+  struct Node* temp = (struct Node*)malloc(sizeof(struct Node));
+  temp->piece.position = (vec2f) {x,y};
+  temp->piece.dimensions = (vec2f) {rand()%10+5,0};
+  temp->piece.flag = true;
+  temp->next = NULL;
+  return temp;
+
+}
 
-    current_time = esp_timer_get_time();
-      
-    cls(rgbToColour(100,0,0));
+static void spawn_sidewall(entity_group* group, uint64_t now) {
 
-    //animate the bubbles, every half a second a new bubble
-    //is added to the linked list with a random x position
-    //and a random size range
-    if (last_enemy_time + 500000 < current_time) {
+  (void) now;
+
+  struct Node* temp = group->list.first;
+  while(temp != NULL) {
+  //add circles if needed, only if the flag is TRUE otherwise it infinitely creates circles and crashes!
+    if(temp->piece.position.y >= 0 && temp->piece.flag) {
+      temp->piece.flag = false; //the bubble can only pass Y=0 once!
+      float x_start = 0;
+      if (temp->piece.position.x > 75) x_start = 135;
+      //a bigger gap means fewer bubbles on screen
+      push_node(&group->list, new_sidewall(x_start,-10-governor_quality()->sidewall_spawn_gap));
+    }
+    temp = temp->next;
+  }
+
+}
+
+static void move_sidewall(Piece* piece, float dt) {
+  piece->velocity = add_vec(first_level_velocity,(vec2f){0,5*level});
+  move_piece(piece,dt);
+}
+
+static void draw_sidewall(const Piece* piece) {
+
+  uint16_t colours[3] = {rgbToColour(50,0,0), rgbToColour(60,0,0), rgbToColour(100,0,0)};
+  //rings go from the outside in, lower quality tiers drop the inner ones
+  for (int ring = 0; ring < governor_quality()->sidewall_rings; ring++) {
+    draw_circle(piece->dimensions.x-ring*2,piece->position.x,piece->position.y,colours[ring]);
+  }
+
+}
+
+static bool sidewall_expired(const Piece* piece) {
+  return piece->position.y>240+piece->dimensions.x;
+}
+
+//create enemies if enough time has passed, time between enemies gets tighter each time
+static void spawn_enemy(entity_group* group, uint64_t now) {
+
+  if (group->last_spawn+(4000000-level*10000) < now) {
+    //check there aren't too many on the board
+    if (group->list.count < first_level_enemies + level && group->list.count <= max_enemies) {
 
       struct Node* temp = NULL;
       temp = (struct Node*)malloc(sizeof(struct Node));
-      temp->piece.position = random_start(135,(vec2f) {20,20});
-      temp->piece.velocity = (vec2f) {0,20};
-      temp->piece.dimensions = (vec2f) {rand()%10+5,0};
+
+      temp->piece.position = random_start(135,enemy_dimesions);
+      temp->piece.velocity = first_level_velocity;
+      temp->piece.dimensions = enemy_dimesions;
       temp->next = NULL;
 
-      if (bubbles.count == 0) {
-          bubbles.first = temp;
-        } else {
-          add_node(bubbles.first,temp);
-        }
-      last_enemy_time = current_time;
-      bubbles.count += 1;
+      push_node(&group->list,temp);
+      group->last_spawn = now;
     }
+  }
 
-    //iterate over the linked list of bubbles moving them, then drawing them
-    //test to ensure some actually exist before running.
-    if (bubbles.first != NULL){
-      struct Node* temp = bubbles.first;
-      while(temp != NULL) {
-        dt = (esp_timer_get_time() - last_frame_time)/1.0e6f;
+}
 
-        temp->piece.position = add_vec(temp->piece.position, mul_vec_by_float(temp->piece.velocity,dt));
-    
-        draw_circle(temp->piece.dimensions.x,temp->piece.position.x,temp->piece.position.y,rgbToColour(120,0,0));
-        draw_circle(temp->piece.dimensions.x-2,temp->piece.position.x,temp->piece.position.y,rgbToColour(135,0,0));
-        temp = temp->next;
+static void move_enemy(Piece* piece, float dt) {
 
+  //level adds some acceleration
+  piece->velocity = add_vec(piece->velocity,mul_vec_by_float((vec2f){0,level*10},dt));
+  //up to a scaling max velocity
+  piece->velocity = min_vector(piece->velocity,add_vec(max_velocity,(vec2f){0,5*level}));
+  //then this is moved
+  move_piece(piece,dt);
 
-      }
-    }
+}
 
-    //clean up the bubbles that have exited the board
-    if (bubbles.first != NULL) {
-      struct Node* temp = bubbles.first;
-      struct Node* to_delete = NULL;
+static bool enemy_expired(const Piece* piece) {
+  return piece->position.y >= 240;
+}
 
-      while(temp != NULL) {
+static entity_group bubbles = {{NULL, 0}, spawn_bubble, move_piece, draw_bubble, bubble_expired, 0, 0};
+static entity_group sidewalls = {{NULL, 0}, spawn_sidewall, move_sidewall, draw_sidewall, sidewall_expired, 0, 0};
+static entity_group enemies = {{NULL, 0}, spawn_enemy, move_enemy, draw_enemy, enemy_expired, 0, 0};
 
-        //advance the temp BEFORE deletion (otherwise you delete it then can't get ->next!)
-        to_delete = temp;
-        temp = temp->next;
+/*
+====================================================
+Scenes
+----------------------------------------------------
+menu - bubbles and title, press A to run
+game - runs until collision detected
+game over - bubbles and score until A pressed
 
-        if (to_delete->piece.position.y >= 240) {
-          delete_node(&bubbles,to_delete);
-        }
-        
-      }
-    }
+Menu and game over share a render, the text to draw
+over the bubbles is picked on enter, and the game over
+score string is formatted once there too
+====================================================
+*/
 
-    setFont(FONT_DEJAVU18);
-    setFontColour(255,255,0);
-    print_xy("BLOODSTREAM",CENTER,CENTER);
-    setFontColour(255,255,255);
-    setFont(FONT_SMALL);
-    print_xy("Use A to veer left",CENTER,LASTY+25);
-    print_xy("Use B to veer right",CENTER,LASTY+18);
-    setFont(FONT_UBUNTU16);
-    print_xy("PRESS A to BEGIN",CENTER,LASTY+20);
-    
-    
-    setFontColour(0,0,0);
-    draw_circle(15,20,220,rgbToColour(255,255,255));
-    draw_circle(15,115,220,rgbToColour(255,255,255));
-    print_xy("A",15,212);
-    print_xy("B",111,212);
-
-    
-    flip_frame();
-    last_frame_time = current_time;
-  }
+static scene menu_scene;
+static scene game_scene;
+static scene game_over_scene;
+
+static void (*bubble_scene_text)(void);
+static char score_string[100];
+
+static void draw_menu_text(void) {
+
+  setFont(FONT_DEJAVU18);
+  setFontColour(255,255,0);
+  print_xy("BLOODSTREAM",CENTER,CENTER);
+  setFontColour(255,255,255);
+  setFont(FONT_SMALL);
+  print_xy("Use A to veer left",CENTER,LASTY+25);
+  print_xy("Use B to veer right",CENTER,LASTY+18);
+  setFont(FONT_UBUNTU16);
+  print_xy("PRESS A to BEGIN",CENTER,LASTY+20);
+
+
+  setFontColour(0,0,0);
+  draw_circle(15,20,220,rgbToColour(255,255,255));
+  draw_circle(15,115,220,rgbToColour(255,255,255));
+  print_xy("A",15,212);
+  print_xy("B",111,212);
+
+}
+
+static void menu_enter(void) {
+
+  crashed = false;
+  level = 1;
+  score = 0;
+
+  bubbles.last_spawn = esp_timer_get_time();
+  pipeline_register(&bubbles);
+  bubble_scene_text = draw_menu_text;
+
+}
+
+static scene* menu_update(uint64_t now, float dt) {
+
+  //awaits user press of the A key
+  if (!gpio_get_level(0)) return &game_scene;
+
+  pipeline_update(now, dt);
+  return NULL;
+
+}
+
+//menu and game over look the same apart from their text
+static void bubble_scene_render(void) {
+
+  cls(rgbToColour(100,0,0));
+  pipeline_draw();
+  bubble_scene_text();
+
+}
+
+static void menu_exit(void) {
 
   //delay start to allow for button release (otherwise the ship just skites off to screen left!)
-   while(esp_timer_get_time() < last_frame_time+500000);
+  uint64_t pressed_time = esp_timer_get_time();
+  while(esp_timer_get_time() < pressed_time+500000);
 
+}
 
-  /* 
+/*
 ====================================================
 Game Startup
 ----------------------------------------------------
-First checks if there is a sidewall drawn, if not 
+First checks if there is a sidewall drawn, if not
 procedurally generates one
 
-Then it creates the ships and sets up other timer 
+Then it creates the ships and sets up other timer
 variables
 ====================================================
 */
+static void game_enter(void) {
 
   //if there are no circles in the procedural sidewalls, seed the sidewalls
-  if(sidewalls.count < 1) {
-    
-    struct Node* temp = NULL;
-    temp = (struct Node*)malloc(sizeof(struct Node));
-
-    temp->piece.position = (vec2f) {0,-10};
-    temp->piece.dimensions = (vec2f) {rand()%10+5,0};
-    temp->piece.flag = true;
-    temp->next = NULL;
-    sidewalls.first = temp;
-    
-    temp = (struct Node*)malloc(sizeof(struct Node));
-    temp->piece.position = (vec2f) {135,-10};
-    temp->piece.dimensions = (vec2f) {rand()%10+5,0};
-    temp->piece.flag = true;
-    temp->next = NULL;
-
-    add_node(sidewalls.first,temp);
-    
+  if(sidewalls.list.count < 1) {
+    push_node(&sidewalls.list, new_sidewall(0,-10));
+    push_node(&sidewalls.list, new_sidewall(135,-10));
   }
-      
-  // create ships
 
-  Piece ship;
+  // create ships
   ship.velocity = (vec2f) {0,0};
+  ship.accel = (vec2f) {0,0};
   ship.dimensions = ship_dimensions;
   ship.position = (vec2f) {135/2+1-ship.dimensions.x/2, max_ship_pos.y};
-  setFontColour(255,255,255);
-  struct linked_list enemies;
-  enemies.count = 0;
-  enemies.first = NULL;
-  
-  last_frame_time = esp_timer_get_time();
-  last_level_time = last_frame_time;
 
-    //set the seed each game so the random generation changes 
-  srand(last_frame_time);
+  uint64_t now = esp_timer_get_time();
+  last_level_time = now;
+  last_hud_time = now;
+  hud_score = score;
+  hud_cached = false;
+  enemies.last_spawn = now;
+
+  //set the seed each game so the random generation changes
+  srand(now);
 
-  /* 
+  pipeline_register(&sidewalls);
+  pipeline_register(&enemies);
+
+}
+
+/*
 ====================================================
 Game
 ----------------------------------------------------
-Draws sidewalls, then takes player inputs
-Moves and draws player piece
-Moves and draws enemies
-Checks collisions and checks for enemies that have
-moved off the game board
+Moves sidewalls and enemies, then takes player inputs
+Moves player piece
+Checks collisions and increments score for enemies
+that have moved off the game board
 
 ====================================================
 */
-  while(!crashed) {
-      
-      cls(rgbToColour(35,0,0));
-      
-      current_time = esp_timer_get_time();
-      dt = (esp_timer_get_time() - last_frame_time)/1.0e6f; //converted to seconds
-
-
-      //Sidewall animation starts here
-      struct Node* temp = sidewalls.first;
-      while(temp != NULL) {
-      //add circles if needed, only if the flag is TRUE otherwise it infinitely creates circles and crashes!
-        if(temp->piece.position.y >= 0 && temp->piece.flag) {
-          temp->piece.flag = false; //the bubble can only pass Y=0 once!
-          struct Node* new = (struct Node*)malloc(sizeof(struct Node));
-          float x_start = 0;
-          if (temp->piece.position.x > 75) x_start = 135; 
-          new->piece.position = (vec2f) {x_start,-10};
-          new->piece.dimensions = (vec2f) {rand()%10+5,0};
-          new->piece.flag = true;
-          new->next = NULL;
-
-          add_node(sidewalls.first,new);
-
-        }
-        temp = temp->next;
-      }
-
-      temp = sidewalls.first;
-      while (temp != NULL) {
-        //move bubbles
-        temp->piece.velocity = add_vec(first_level_velocity,(vec2f){0,5*level});
-        temp->piece.position = add_vec(temp->piece.position, mul_vec_by_float(temp->piece.velocity,dt));
-        //draw bubbles
-        draw_circle(temp->piece.dimensions.x,temp->piece.position.x,temp->piece.position.y,rgbToColour(50,0,0));
-        draw_circle(temp->piece.dimensions.x-2,temp->piece.position.x,temp->piece.position.y,rgbToColour(60,0,0));
-        draw_circle(temp->piece.dimensions.x-4,temp->piece.position.x,temp->piece.position.y,rgbToColour(100,0,0));
-
-        temp = temp->next;
-      }
-
-      //delete and clean up if required
-      temp = sidewalls.first;
-      while(temp != NULL) {
-        struct Node* to_delete = NULL;
-        to_delete = temp;
-        temp = temp->next;
-        //remove bubbles if needed
-        if (to_delete->piece.position.y>240+to_delete->piece.dimensions.x) {
-          delete_node(&sidewalls,to_delete);
-        }
-      }
-    
-      //accelerate the ship based on the status of the buttons
-      //left thrusts left, right right and both together thrusts forwards
-      if(!gpio_get_level(0) && !gpio_get_level(35)) {
-
-          // ship.accel = (vec2f) {0,-1*thrust_accel}; to be replaced with shooting mechanism
-
-      } else if (!gpio_get_level(0)) {
-
-          ship.accel = (vec2f) {-1*thrust_accel,0};
-
-      } else if (!gpio_get_level(35)) {
-
-          ship.accel = (vec2f) {thrust_accel,0};
-
-      } else {
-
-        //what to do if no buttons are pressed!
-        if (ship.velocity.x < 0) { 
-          ship.accel.x = drag_decel;
-        } else if (ship.velocity.x > 0) {
-          ship.accel.x = -1*drag_decel;
-        } else {
-          ship.accel.x = 0;
-        }
-        
-
-      }
-
-      //move the ship - accelerates, checks against terminal velocities, then moves and tests if within boundaries.
-      //acceleration is velocity + accel * delta time
-
-
-      ship.velocity = add_vec(ship.velocity,mul_vec_by_float(ship.accel,dt));
-      //test that the ship is not going faster than it's max velocity
-      ship.velocity = min_vector(ship.velocity,max_velocity);
-      //move the ship by it's speed and time travelled
-      ship.position = add_vec(ship.position,mul_vec_by_float(ship.velocity,dt));
-      ship.position = max_vector(ship.position, min_ship_pos);
-      ship.position = min_vector(ship.position, max_ship_pos);
-
-      draw_ship(ship);
-
-      //create enemies if enough time has passed, time between enemies gets tighter each time
-      if (last_enemy_time+(4000000-level*10000) < current_time) {
-          //check there aren't too many on the board
-          if (enemies.count < first_level_enemies + level && enemies.count <= max_enemies) {
-            
-            struct Node* temp = NULL;
-            temp = (struct Node*)malloc(sizeof(struct Node));
-
-            temp->piece.position = random_start(135,enemy_dimesions);
-            temp->piece.velocity = first_level_velocity;
-            temp->piece.dimensions = enemy_dimesions;
-            temp->next = NULL;
-
-            if (enemies.count == 0) {
-              enemies.first = temp;
-            } else {
-              add_node(enemies.first,temp);
-            }
-            enemies.count++;
-            last_enemy_time = current_time;
-          }
-
-      }
-
-      // //iterate over the linked list of enemies moving them, then drawing them
-      //test to ensure some actually exist before running.
-      if (enemies.first != NULL){
-        struct Node* temp = enemies.first;
-        while(temp != NULL) {
-          dt = (esp_timer_get_time() - last_frame_time)/1.0e6f; //recalculating to handle slight time changes making jerky movements
-          //test if out of screen yet and if so delete from the ll
-          //this occurs here so that temp can become the next in the list before all the moves etc
-          //level adds some acceleration
-          temp->piece.velocity = add_vec(temp->piece.velocity,mul_vec_by_float((vec2f){0,level*10},dt));
-          //up to a scaling max velocity
-          temp->piece.velocity = min_vector(temp->piece.velocity,add_vec(max_velocity,(vec2f){0,5*level}));
-          //then this is moved
-          temp->piece.position = add_vec(temp->piece.position, mul_vec_by_float(temp->piece.velocity,dt));
-          //this has to be set as a result, otherwise it just swaps between states as it scans through each item in the LL
-            if (test_collision(temp->piece,ship)) crashed = true;
-            draw_enemy(temp->piece);
-            temp = temp->next;
-
-          
-
-        }
-      }
-
-      //clean up the pieces that have exited the board and increment score
-      if (enemies.first != NULL) {
-        struct Node* temp = enemies.first;
-        struct Node* to_delete = NULL;
-
-        while(temp != NULL) {
-
-          //advance the temp BEFORE deletion (otherwise you delete it then can't get ->next!)
-          to_delete = temp;
-          temp = temp->next;
-
-          if (to_delete->piece.position.y >= 240) {
-            delete_node(&enemies,to_delete);
-            score+=100;
-          }
-          
-        }
-
-      }
-
-      //increment level every 10 seconds, this is too short for a real game, but for demo purposes of the speed changing etc
-      //works quite well
-
-      if (last_level_time+10000000 < current_time) {
-
-        level += 1;
-        last_level_time = current_time;
-        
-      }
-
-      //draw scoreboard
-      draw_rectangle(0,0,240,16,rgbToColour(30,30,100));
-      gprintf("Score: %d",score);
-
-      //display level change
-      if (last_level_time + 1000000 > current_time && level > 1) {
-        draw_rectangle(0,105,240,30,rgbToColour(255,0,0));
-        snprintf(level_string,sizeof(level_string),"LEVEL %d",level);
-        print_xy(level_string,CENTER,CENTER);
-      }
-
-      last_frame_time = current_time;
-      flip_frame();
+static scene* game_update(uint64_t now, float dt) {
+
+  //the crash was drawn last frame, so the player sees what they hit before game over
+  if (crashed) return &game_over_scene;
+
+  pipeline_update(now, dt);
+  score += enemies.removed * 100;
+
+  //accelerate the ship based on the status of the buttons
+  //left thrusts left, right right and both together thrusts forwards
+  if(!gpio_get_level(0) && !gpio_get_level(35)) {
+
+      // ship.accel = (vec2f) {0,-1*thrust_accel}; to be replaced with shooting mechanism
 
+  } else if (!gpio_get_level(0)) {
 
+      ship.accel = (vec2f) {-1*thrust_accel,0};
+
+  } else if (!gpio_get_level(35)) {
+
+      ship.accel = (vec2f) {thrust_accel,0};
+
+  } else {
+
+    //what to do if no buttons are pressed!
+    if (ship.velocity.x < 0) {
+      ship.accel.x = drag_decel;
+    } else if (ship.velocity.x > 0) {
+      ship.accel.x = -1*drag_decel;
+    } else {
+      ship.accel.x = 0;
     }
 
-/* 
+
+  }
+
+  //move the ship - accelerates, checks against terminal velocities, then moves and tests if within boundaries.
+  //acceleration is velocity + accel * delta time
+  ship.velocity = add_vec(ship.velocity,mul_vec_by_float(ship.accel,dt));
+  //test that the ship is not going faster than it's max velocity
+  ship.velocity = min_vector(ship.velocity,max_velocity);
+  //move the ship by it's speed and time travelled
+  ship.position = add_vec(ship.position,mul_vec_by_float(ship.velocity,dt));
+  ship.position = max_vector(ship.position, min_ship_pos);
+  ship.position = min_vector(ship.position, max_ship_pos);
+
+  struct Node* temp = enemies.list.first;
+  while(temp != NULL) {
+    if (test_collision(temp->piece,ship)) crashed = true;
+    temp = temp->next;
+  }
+
+  //increment level every 10 seconds, this is too short for a real game, but for demo purposes of the speed changing etc
+  //works quite well
+  if (last_level_time+10000000 < now) {
+
+    level += 1;
+    last_level_time = now;
+
+  }
+
+  if (last_hud_time + governor_quality()->hud_interval <= now) {
+    hud_score = score;
+    last_hud_time = now;
+  }
+
+  return NULL;
+
+}
+
+static void game_render(void) {
+
+  char level_string[100];
+
+  //sidewalls, then the ship, then enemies over the top
+  cls(rgbToColour(35,0,0));
+  pipeline_draw_group(&sidewalls);
+  draw_ship(ship);
+  pipeline_draw_group(&enemies);
+
+  //draw scoreboard, the bar covers the full width of its rows so a straight copy restores it
+  if (hud_cached && hud_cached_score == hud_score) {
+    memcpy(frame_buffer, hud_cache, HUD_ROWS * display_width * sizeof(uint16_t));
+  } else {
+    draw_rectangle(0,0,240,HUD_ROWS,rgbToColour(30,30,100));
+    setFont(FONT_UBUNTU16); //the debug overlay can leave a different font selected
+    setFontColour(255,255,255);
+    gprintf("Score: %d",hud_score);
+    memcpy(hud_cache, frame_buffer, HUD_ROWS * display_width * sizeof(uint16_t));
+    hud_cached_score = hud_score;
+    hud_cached = true;
+  }
+
+  //display level change
+  if (last_level_time + 1000000 > esp_timer_get_time() && level > 1) {
+    setFont(FONT_UBUNTU16);
+    setFontColour(255,255,255);
+    draw_rectangle(0,105,240,30,rgbToColour(255,0,0));
+    snprintf(level_string,sizeof(level_string),"LEVEL %d",level);
+    print_xy(level_string,CENTER,CENTER);
+  }
+
+}
+
+static void game_exit(void) {
+
+  //delete any enemies remaining in the linked list
+  clear_list(&enemies.list);
+
+}
+
+/*
 ====================================================
 Game Over
 ----------------------------------------------------
-Clears enemies LL, and restarts the bubble background
-awaits user input showing them game over, and their 
-score
+Restarts the bubble background, awaits user input
+showing them game over, and their score
 ====================================================
 */
-  //delete any enemies remaining in the linked list
-  clear_list(&enemies);
- // clear_list(&bubbles);
+static void draw_game_over_text(void) {
 
-  while(gpio_get_level(0)){
+  setFont(FONT_DEJAVU24);
+  setFontColour(255,255,255);
+  print_xy("GAME",CENTER,20);
+  print_xy("OVER",CENTER,LASTY+25);
+  setFont(FONT_UBUNTU16);
+  print_xy(score_string,CENTER,LASTY+30);
+  print_xy("Press A",CENTER,LASTY+30);
 
+}
 
-    current_time = esp_timer_get_time();
-      
-      cls(rgbToColour(100,0,0));
+static void game_over_enter(void) {
 
-      //animate the bubbles
-      if (last_enemy_time + 500000 < current_time) {
+  pipeline_register(&bubbles);
+  snprintf(score_string,sizeof(score_string),"Your score: %" PRIu32, score);
+  bubble_scene_text = draw_game_over_text;
 
-        struct Node* temp = NULL;
-        temp = (struct Node*)malloc(sizeof(struct Node));
+}
 
-        temp->piece.position = random_start(135,(vec2f) {20,20});
-        temp->piece.velocity = (vec2f) {0,20};
-        temp->piece.dimensions = (vec2f) {rand()%10+5,0};
-        temp->next = NULL;
+static scene* game_over_update(uint64_t now, float dt) {
 
-        if (bubbles.count == 0) {
-            bubbles.first = temp;
-          } else {
-            add_node(bubbles.first,temp);
-          }
-        last_enemy_time = current_time;
-        bubbles.count += 1;
-      }
+  if (!gpio_get_level(0)) return &menu_scene;
 
-      // //iterate over the linked list of bubbles moving them, then drawing them
-      //test to ensure some actually exist before running.
-      if (bubbles.first != NULL){
-        struct Node* temp = bubbles.first;
-        while(temp != NULL) {
-          dt = (esp_timer_get_time() - last_frame_time)/1.0e6f;
+  pipeline_update(now, dt);
+  return NULL;
 
-          temp->piece.position = add_vec(temp->piece.position, mul_vec_by_float(temp->piece.velocity,dt));
-      
-          draw_circle(temp->piece.dimensions.x,temp->piece.position.x,temp->piece.position.y,rgbToColour(120,0,0));
-          draw_circle(temp->piece.dimensions.x-2,temp->piece.position.x,temp->piece.position.y,rgbToColour(135,0,0));
-          temp = temp->next;
+}
 
+static void game_over_exit(void) {
 
-        }
-      }
+  //delay to stop it immediately starting a new game
+  uint64_t pressed_time = esp_timer_get_time();
+  while(esp_timer_get_time() < pressed_time+1000000);
 
-      //clean up the pieces that have exited the board
-      if (bubbles.first != NULL) {
-        struct Node* temp = bubbles.first;
-        struct Node* to_delete = NULL;
+}
 
-        while(temp != NULL) {
+static scene menu_scene = {"menu", menu_enter, menu_update, bubble_scene_render, menu_exit, 0, 0, 0};
+static scene game_scene = {"game", game_enter, game_update, game_render, game_exit, 0, 0, 0};
+static scene game_over_scene = {"game over", game_over_enter, game_over_update, bubble_scene_render, game_over_exit, 0, 0, 0};
 
-          //advance the temp BEFORE deletion (otherwise you delete it then can't get ->next!)
-          to_delete = temp;
-          temp = temp->next;
+/*
+====================================================
+Main
+----------------------------------------------------
+Gets a splash frame up as soon as the display is
+ready, then the rest of the setup, then hands over
+to the scene loop starting at the menu. Each stage
+is timestamped, and the breakdown is printed once
+the first menu frame is on screen
 
-          if (to_delete->piece.position.y >= 240) {
-            delete_node(&bubbles,to_delete);
-          }
-          
-        }
-      }
+====================================================
+*/
 
+static void draw_splash(void) {
 
-    setFont(FONT_DEJAVU24);
-    print_xy("GAME",CENTER,20);
-    print_xy("OVER",CENTER,LASTY+25);
-    setFont(FONT_UBUNTU16);
-    
-    snprintf(score_string,sizeof(score_string),"Your score: %" PRIu32, score);
+  cls(rgbToColour(100,0,0));
+  setFont(FONT_DEJAVU18);
+  setFontColour(255,255,0);
+  print_xy("BLOODSTREAM",CENTER,CENTER);
 
+}
 
+void app_main() {
 
-    print_xy(score_string,CENTER,LASTY+30);
-    
-    print_xy("Press A",CENTER,LASTY+30);
-    last_frame_time = current_time;
-    flip_frame();
-   
-  }
-    //delay to stop it immediately starting a new game
-    last_frame_time = esp_timer_get_time();
-    while(esp_timer_get_time() < last_frame_time+1000000);
+  boot_mark("app_main");
 
+  // graphics initialisations first so there is something on screen quickly
+  graphics_init();
+  boot_mark("graphics_init");
+  set_orientation(PORTRAIT);
+  boot_mark("set_orientation");
+  draw_splash();
+  flip_frame();
+  boot_mark("splash");
 
-  }
+  // configurations for GPIO
+  gpio_set_direction(0,GPIO_MODE_INPUT);
+  gpio_set_direction(35,GPIO_MODE_INPUT);
+  display_diff_init();
+  boot_mark("display_diff_init");
 
-}
\ No newline at end of file
+  governor_init(frame_budget);
+  boot_mark("governor_init");
+
+  scene_run(&menu_scene);
+
+}
@@ -0,0 +1,64 @@
+#include<stdlib.h>
+#include "pieces.h"
+
+void add_node(struct Node *list, struct Node *new) {
+
+  while(list->next != NULL) {
+    list= list->next;
+  }
+  list->next = new;
+
+}
+
+//appends to the end of the list, and keeps the count in step with add/delete
+void push_node(struct linked_list *head, struct Node *new) {
+
+  if (head->first == NULL) {
+    head->first = new;
+  } else {
+    add_node(head->first,new);
+  }
+  head->count++;
+
+}
+
+void delete_node(struct linked_list* head, struct Node* target) {
+
+  struct Node* temp = head->first;
+  struct Node* previous = NULL;
+
+  while(temp != target) {
+    previous = temp;
+    temp = temp->next;
+  }
+
+  if(previous == NULL) {
+    head->first = temp->next;
+    head->count--;
+    free(temp);
+  } else {
+    previous->next = temp->next;
+    head->count--;
+    free(temp);
+  }
+
+}
+
+void clear_list(struct linked_list *head) {
+
+  struct Node* temp = head->first;
+  struct Node* previous = NULL;
+
+  while (temp != NULL) {
+
+    previous = temp;
+    temp = temp->next;
+    free(previous);
+
+  }
+
+  head->first = NULL;
+  head->count = 0;
+
+
+}
@@ -0,0 +1,56 @@
+#ifndef PIECES_H
+#define PIECES_H
+
+#include<stdbool.h>
+#include<stdint.h>
+
+/* 
+====================================================
+Struct Definitions
+----------------------------------------------------
+
+vec2f is a utility vector with 2 floats, used for all
+the X/Y type calcs (position, velocity, acceleration)
+
+Piece is a struct made up of mostly vec2f and a 
+utility flag, and represents any moving piece
+
+linked_list and Node work together, linked_list is the 
+head, and holds a incrementing counter and the pointer
+to the first LL element 
+
+====================================================
+*/
+
+
+//Float vector (used for coordinates and velocities)
+typedef struct { float x; float y; } vec2f;
+
+//game pieces
+typedef struct Piece {
+  //Using 2d vector for pieces allows me to use a lot of generic code
+  //its designed with 2d movement in mind, but at present player only
+  //moves side to side, and enemies top to bottom
+  vec2f dimensions;
+  vec2f position;
+  vec2f velocity;
+  vec2f accel;
+  bool flag;
+
+} Piece;
+
+typedef struct Node {
+  Piece piece;
+  struct Node* next;
+} Node;
+typedef struct linked_list {
+  struct Node* first;
+  uint16_t count;
+} linked_list;
+
+void add_node(struct Node *list, struct Node *new);
+void push_node(struct linked_list *head, struct Node *new);
+void delete_node(struct linked_list* head, struct Node* target);
+void clear_list(struct linked_list *head);
+
+#endif
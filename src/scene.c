@@ -0,0 +1,159 @@
+#include<esp_timer.h>
+#include<graphics.h>
+#include<inttypes.h>
+#include<stdio.h>
+#include "boot.h"
+#include "display_diff.h"
+#include "governor.h"
+#include "scene.h"
+
+#define MAX_GROUPS 4
+
+static entity_group* groups[MAX_GROUPS];
+static uint8_t group_count;
+
+//display totals when the current scene was entered, so its own transfer savings can be reported
+static uint64_t enter_bytes, enter_full_bytes;
+
+/*
+====================================================
+Entity pipeline
+====================================================
+*/
+
+void pipeline_register(entity_group* group) {
+
+  if (group_count < MAX_GROUPS) {
+    groups[group_count++] = group;
+  } else {
+    printf("pipeline: no room for another entity group\n");
+  }
+
+}
+
+//only forgets the groups, their lists are left alone so pieces carry over between scenes
+void pipeline_clear(void) {
+  group_count = 0;
+}
+
+void pipeline_update(uint64_t now, float dt) {
+
+  for (int i = 0; i < group_count; i++) {
+
+    entity_group* group = groups[i];
+    group->removed = 0;
+
+    if (group->spawn != NULL) group->spawn(group, now);
+
+    struct Node* temp = group->list.first;
+    struct Node* to_delete = NULL;
+
+    while(temp != NULL) {
+
+      //advance the temp BEFORE deletion (otherwise you delete it then can't get ->next!)
+      to_delete = temp;
+      temp = temp->next;
+
+      if (group->move != NULL) group->move(&to_delete->piece, dt);
+      if (group->expired != NULL && group->expired(&to_delete->piece)) {
+        delete_node(&group->list, to_delete);
+        group->removed++;
+      }
+
+    }
+
+  }
+
+}
+
+void pipeline_draw_group(entity_group* group) {
+
+  if (group->draw == NULL) return;
+  struct Node* temp = group->list.first;
+  while(temp != NULL) {
+    group->draw(&temp->piece);
+    temp = temp->next;
+  }
+
+}
+
+void pipeline_draw(void) {
+
+  for (int i = 0; i < group_count; i++) {
+    pipeline_draw_group(groups[i]);
+  }
+
+}
+
+/*
+====================================================
+Scene loop
+====================================================
+*/
+
+static void enter_scene(scene* s) {
+
+  pipeline_clear();
+  s->frames = 0;
+  s->update_time = 0;
+  s->render_time = 0;
+  enter_bytes = display_get_stats()->total_bytes;
+  enter_full_bytes = display_get_stats()->total_full_bytes;
+  if (s->enter != NULL) s->enter();
+
+}
+
+static void exit_scene(scene* s) {
+
+  if (s->frames > 0) {
+    const display_stats* display = display_get_stats();
+    printf("scene %s: %" PRIu32 " frames, avg update %" PRIu32 "us, avg render %" PRIu32 "us, sent %" PRIu32 " of %" PRIu32 " bytes/frame\n",
+      s->name, s->frames,
+      (uint32_t) (s->update_time / s->frames), (uint32_t) (s->render_time / s->frames),
+      (uint32_t) ((display->total_bytes - enter_bytes) / s->frames),
+      (uint32_t) ((display->total_full_bytes - enter_full_bytes) / s->frames));
+  }
+  if (s->exit != NULL) s->exit();
+
+}
+
+void scene_run(scene* first) {
+
+  scene* current = first;
+  enter_scene(current);
+  boot_mark("first scene enter");
+  uint64_t current_time, update_done, render_done, last_frame_time = esp_timer_get_time();
+  float dt;
+
+  for(;;) {
+
+    current_time = esp_timer_get_time();
+    dt = (current_time - last_frame_time)/1.0e6f; //converted to seconds
+
+    scene* next = current->update(current_time, dt);
+    update_done = esp_timer_get_time();
+
+    if (next != NULL) {
+      exit_scene(current);
+      current = next;
+      enter_scene(current);
+      last_frame_time = esp_timer_get_time();
+      continue;
+    }
+
+    current->render();
+    render_done = esp_timer_get_time();
+
+    current->frames++;
+    current->update_time += update_done - current_time;
+    current->render_time += render_done - update_done;
+
+    governor_frame(current_time - last_frame_time);
+    governor_draw_overlay();
+    last_frame_time = current_time;
+    display_present();
+    boot_first_frame();
+
+  }
+
+}
@@ -0,0 +1,74 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include<stdbool.h>
+#include<stdint.h>
+#include "pieces.h"
+
+/*
+====================================================
+Entity pipeline
+----------------------------------------------------
+
+An entity_group is a linked list of pieces plus the
+hooks that spawn, move, draw and expire them. Scenes
+register the groups they want on enter, and the
+pipeline runs them all in registration order, so the
+spawn/move/draw/cleanup loops are only written once.
+
+Any hook can be left NULL. removed counts the pieces
+cleaned up in the last update (enemies use it for score).
+pipeline_draw_group draws a single group, for scenes that
+need to draw something else in between groups.
+
+====================================================
+*/
+
+typedef struct entity_group {
+  struct linked_list list;
+  void (*spawn)(struct entity_group* group, uint64_t now);
+  void (*move)(Piece* piece, float dt);
+  void (*draw)(const Piece* piece);
+  bool (*expired)(const Piece* piece);
+  uint64_t last_spawn;
+  uint16_t removed;
+} entity_group;
+
+void pipeline_register(entity_group* group);
+void pipeline_clear(void);
+void pipeline_update(uint64_t now, float dt);
+void pipeline_draw_group(entity_group* group);
+void pipeline_draw(void);
+
+/*
+====================================================
+Scenes
+----------------------------------------------------
+
+enter prepares the scene (register groups, set up
+anything that doesn't change while it's showing),
+update returns the next scene or NULL to stay, render
+draws the frame, exit tidies up. Scenes are static
+structs so switching never allocates.
+
+scene_run owns the frame loop: timing, the quality
+governor and presenting the frame, and keeps per scene
+update/render timings that are printed on exit.
+
+====================================================
+*/
+
+typedef struct scene {
+  const char* name;
+  void (*enter)(void);
+  struct scene* (*update)(uint64_t now, float dt);
+  void (*render)(void);
+  void (*exit)(void);
+  uint32_t frames;
+  uint64_t update_time;
+  uint64_t render_time;
+} scene;
+
+void scene_run(scene* first);
+
+#endif